@@ -0,0 +1,321 @@
+#ifndef AGENTS_HPP
+#define AGENTS_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <thread>
+#include <vector>
+
+#include "maze.hpp"
+#include "profiler.hpp"
+#include "tile.hpp"
+
+// Simulates large numbers of AI walkers through a generated maze.
+// Agent state is kept as a structure of arrays so a step is a tight loop
+// over contiguous positions, with every movement decision reduced to a
+// table lookup on a per-cell mask of open neighbours.
+class agent_swarm
+{
+public:
+    enum behaviour { RANDOM_WALKER = 0, WALL_FOLLOWER = 1, SOLVER_FOLLOWER = 2 };
+
+    struct step_report
+    {
+        size_t agents;
+        int steps;
+        unsigned threads;
+        uint64_t agent_steps;
+        double seconds;
+        double agent_steps_per_second;
+    };
+
+    agent_swarm(maze &m, uint32_t seed = 1)
+        : width_(m.width()), height_(m.height()),
+          stride_(m.width() + 2), seed_(seed ? seed : 1),
+          exit_cell_(-1)
+    {
+        build_cell_masks(m);
+        build_tables();
+        build_flow_field();
+    }
+
+    ~agent_swarm()
+    {
+    }
+
+    void add_agents(enum behaviour kind, size_t count, tile::position start = { 0, 0 })
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            x_.push_back(start.x);
+            y_.push_back(start.y);
+            heading_.push_back(EAST);
+            kind_.push_back(static_cast<int32_t>(kind));
+
+            // xorshift state must never be zero
+            seed_ = seed_ * 1664525u + 1013904223u;
+            rng_.push_back(seed_ | 1u);
+        }
+    }
+
+    size_t size() const { return x_.size(); }
+
+    tile::position get_agent_position(size_t agent) const
+    {
+        return { x_[agent], y_[agent] };
+    }
+
+    void step(int steps)
+    {
+        step_range(0, size(), steps);
+    }
+
+    // steps every agent 'steps' times, splitting the agents across
+    // 'threads' workers (0 = one per hardware thread)
+    step_report run(int steps, unsigned threads = 0)
+    {
+        if (threads == 0)
+        { threads = std::max(1u, std::thread::hardware_concurrency()); }
+        threads = static_cast<unsigned>(std::max<size_t>(1, std::min<size_t>(threads, size())));
+
+        auto start = std::chrono::steady_clock::now();
+
+        if (threads == 1)
+        {
+            step_range(0, size(), steps);
+        }
+        else
+        {
+            std::vector<std::thread> workers;
+            size_t chunk = (size() + threads - 1) / threads;
+            for (unsigned t = 0; t < threads; t++)
+            {
+                size_t begin = std::min(size(), t * chunk);
+                size_t end   = std::min(size(), begin + chunk);
+                workers.emplace_back([this, begin, end, steps]() { step_range(begin, end, steps); });
+            }
+
+            for (auto &w : workers)
+            { w.join(); }
+        }
+
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        step_report report = {0};
+        report.agents      = size();
+        report.steps       = steps;
+        report.threads     = threads;
+        report.agent_steps = static_cast<uint64_t>(size()) * static_cast<uint64_t>(steps);
+        report.seconds     = elapsed.count();
+        report.agent_steps_per_second = report.seconds > 0.0 ? report.agent_steps / report.seconds : 0.0;
+        return report;
+    }
+
+private:
+    // clockwise so that turning is plain arithmetic on the index,
+    // STAY is used when an agent has nowhere (or no need) to go
+    enum heading { NORTH = 0, EAST = 1, SOUTH = 2, WEST = 3, STAY = 4 };
+
+    // agents are stepped in blocks small enough to stay in L1 across steps
+    static constexpr size_t BLOCK_SIZE = 256;
+
+    // 12 is divisible by every possible count of open neighbours,
+    // so picking one of 12 slots is uniform over the open directions
+    static constexpr int RANDOM_SLOTS = 12;
+
+    int width_;
+    int height_;
+    int stride_;
+
+    uint32_t seed_;
+    int exit_cell_;
+
+    // padded (width + 2) * (height + 2) grid, the border is always blocked
+    // which removes every bounds check from the inner loop.
+    // Everything the step loop reads is 32 bits wide and the tables are
+    // flat, so the lookups can become vector gathers.
+    std::vector<int32_t> open_mask_;
+    std::vector<int32_t> flow_;
+
+    int32_t random_pick_[16 * RANDOM_SLOTS]; // [mask * RANDOM_SLOTS + slot]
+    int32_t left_hand_[16 * 4];              // [mask * 4 + heading]
+
+    std::vector<int32_t> x_;
+    std::vector<int32_t> y_;
+    std::vector<int32_t> heading_;
+    std::vector<int32_t> kind_;
+    std::vector<uint32_t> rng_;
+
+    int cell_index(int x, int y) const
+    {
+        return (y + 1) * stride_ + (x + 1);
+    }
+
+    void build_cell_masks(maze &m)
+    {
+        std::vector<uint8_t> open(static_cast<size_t>(stride_) * (height_ + 2), 0);
+        for (int y = 0; y < height_; y++)
+        {
+            for (int x = 0; x < width_; x++)
+            {
+                maze::tile_state state = m.get_tile({ x, y });
+                open[cell_index(x, y)] = state != maze::BLOCKED;
+                if (state == maze::EXIT)
+                { exit_cell_ = cell_index(x, y); }
+            }
+        }
+
+        open_mask_.assign(open.size(), 0);
+        for (int y = 0; y < height_; y++)
+        {
+            for (int x = 0; x < width_; x++)
+            {
+                int cell = cell_index(x, y);
+                open_mask_[cell] = static_cast<int32_t>((open[cell - stride_] << NORTH) |
+                                                        (open[cell + 1]       << EAST)  |
+                                                        (open[cell + stride_] << SOUTH) |
+                                                        (open[cell - 1]       << WEST));
+            }
+        }
+    }
+
+    void build_tables()
+    {
+        for (int mask = 0; mask < 16; mask++)
+        {
+            uint8_t dirs[4];
+            int num_dirs = 0;
+            for (int d = 0; d < 4; d++)
+            {
+                if (mask & (1 << d))
+                { dirs[num_dirs++] = static_cast<uint8_t>(d); }
+            }
+
+            for (int slot = 0; slot < RANDOM_SLOTS; slot++)
+            {
+                random_pick_[mask * RANDOM_SLOTS + slot] = num_dirs ? dirs[slot % num_dirs] : static_cast<int32_t>(STAY);
+            }
+
+            // left hand on the wall: try left, straight, right, then back
+            for (int h = 0; h < 4; h++)
+            {
+                const int order[4] = { (h + 3) & 3, h, (h + 1) & 3, (h + 2) & 3 };
+                left_hand_[mask * 4 + h] = STAY;
+                for (int d : order)
+                {
+                    if (mask & (1 << d))
+                    {
+                        left_hand_[mask * 4 + h] = d;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    // BFS outwards from the exit, every reached cell stores the direction
+    // leading one step closer to it
+    void build_flow_field()
+    {
+        flow_.assign(open_mask_.size(), STAY);
+
+        int exit = exit_cell_;
+        if (exit < 0)
+        { return; }
+
+        const int offsets[4] = { -stride_, 1, stride_, -1 };
+        std::vector<uint8_t> seen(open_mask_.size(), 0);
+        std::deque<int> queue;
+        queue.push_back(exit);
+        seen[exit] = 1;
+
+        while (!queue.empty())
+        {
+            int cell = queue.front();
+            queue.pop_front();
+
+            for (int d = 0; d < 4; d++)
+            {
+                if (!(open_mask_[cell] & (1 << d)))
+                { continue; }
+
+                int next = cell + offsets[d];
+                if (seen[next])
+                { continue; }
+
+                seen[next] = 1;
+                flow_[next] = (d + 2) & 3;
+                queue.push_back(next);
+            }
+        }
+    }
+
+    void step_range(size_t begin, size_t end, int steps)
+    {
+        PROFILE_FUNCTION();
+
+        for (size_t block = begin; block < end; block += BLOCK_SIZE)
+        {
+            size_t block_end = std::min(end, block + BLOCK_SIZE);
+            int count = static_cast<int>(block_end - block);
+
+            for (int s = 0; s < steps; s++)
+            {
+                step_block(count, stride_, random_pick_, left_hand_, open_mask_.data(), flow_.data(),
+                           x_.data() + block, y_.data() + block, heading_.data() + block,
+                           kind_.data() + block, rng_.data() + block);
+            }
+        }
+    }
+
+    // one step for 'count' agents. Everything comes in as restrict qualified
+    // parameters rather than members, so stores to the agent arrays can't
+    // alias the tables or the stride and nothing is reloaded in the loop.
+    // The body is branch free and table driven, and it vectorizes with gathers.
+    static void step_block(int count, int stride,
+                           const int32_t * __restrict random_pick,
+                           const int32_t * __restrict left_hand,
+                           const int32_t * __restrict masks,
+                           const int32_t * __restrict flow,
+                           int32_t * __restrict xs,
+                           int32_t * __restrict ys,
+                           int32_t * __restrict headings,
+                           const int32_t * __restrict kinds,
+                           uint32_t * __restrict rngs)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            int32_t x = xs[i];
+            int32_t y = ys[i];
+            int32_t heading = headings[i];
+            int32_t kind = kinds[i];
+
+            int32_t cell = (y + 1) * stride + (x + 1);
+            int32_t mask = masks[cell];
+
+            uint32_t r = rngs[i];
+            r ^= r << 13;
+            r ^= r >> 17;
+            r ^= r << 5;
+            rngs[i] = r;
+
+            // multiply-shift instead of % keeps the slot pick vectorizable
+            int32_t slot = static_cast<int32_t>(((r >> 16) * RANDOM_SLOTS) >> 16);
+
+            int32_t random_dir = random_pick[mask * RANDOM_SLOTS + slot];
+            int32_t follow_dir = left_hand[mask * 4 + heading];
+            int32_t solver_dir = flow[cell];
+
+            int32_t dir = kind == RANDOM_WALKER ? random_dir :
+                          kind == WALL_FOLLOWER ? follow_dir : solver_dir;
+
+            xs[i] = x + (dir == EAST) - (dir == WEST);
+            ys[i] = y + (dir == SOUTH) - (dir == NORTH);
+            headings[i] = dir == STAY ? heading : dir;
+        }
+    }
+};
+
+#endif
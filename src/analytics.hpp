@@ -0,0 +1,250 @@
+#ifndef ANALYTICS_HPP
+#define ANALYTICS_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "maze.hpp"
+#include "profiler.hpp"
+
+// Difficulty metrics for a generated maze
+struct maze_stats
+{
+    int passages;
+    int dead_ends;        // passages with exactly one open neighbour
+    int junctions;        // passages with three or more open neighbours
+    int corridors;        // runs of passages between dead ends / junctions
+    int longest_corridor; // in steps
+    double mean_corridor;
+    int solution_length;  // steps from the top left corner to the exit, -1 if unreachable
+    int diameter;         // longest shortest path between any two passages
+};
+
+// Computes maze_stats over the grid returned by maze::generate_maze.
+// Neighbour counting and corridor walks are one pass over blocks of rows
+// shared between worker threads, while the calling thread runs the two
+// BFS needed for the solution length and the diameter.
+class maze_analytics
+{
+public:
+    maze_analytics(const int *grid, int width, int height)
+        : grid_(grid), width_(width), height_(height)
+    {
+    }
+
+    ~maze_analytics()
+    {
+    }
+
+    maze_stats analyze(unsigned threads = 0)
+    {
+        PROFILE_FUNCTION();
+
+        if (threads == 0)
+        { threads = std::max(1u, std::thread::hardware_concurrency()); }
+
+        int num_blocks = (height_ + ROW_BLOCK - 1) / ROW_BLOCK;
+        threads = std::max(1u, std::min(threads, static_cast<unsigned>(num_blocks)));
+
+        std::vector<partial> partials(threads);
+        std::atomic<int> next_block(0);
+
+        auto worker = [&](unsigned t)
+        {
+            int block;
+            while ((block = next_block.fetch_add(1)) < num_blocks)
+            {
+                PROFILE_SCOPE("count_rows");
+                count_rows(block * ROW_BLOCK, std::min(height_, (block + 1) * ROW_BLOCK), partials[t]);
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (unsigned t = 1; t < threads; t++)
+        { workers.emplace_back(worker, t); }
+
+        maze_stats stats = {0};
+        measure_paths(stats);
+
+        worker(0);
+        for (auto &w : workers)
+        { w.join(); }
+
+        long long corridor_steps = 0;
+        for (const partial &p : partials)
+        {
+            stats.passages  += p.passages;
+            stats.dead_ends += p.dead_ends;
+            stats.junctions += p.junctions;
+            stats.corridors += p.corridors;
+            stats.longest_corridor = std::max(stats.longest_corridor, p.longest_corridor);
+            corridor_steps += p.corridor_steps;
+        }
+        stats.mean_corridor = stats.corridors ? static_cast<double>(corridor_steps) / stats.corridors : 0.0;
+
+        return stats;
+    }
+
+private:
+    // rows handed out to a worker at a time, a block and its two
+    // neighbouring rows stay in cache while it is counted
+    static constexpr int ROW_BLOCK = 32;
+
+    // one per thread. alignas(64) isn't honoured by std::vector before
+    // C++17, so a trailing cache line of padding keeps the counters of
+    // neighbouring threads at least 64 bytes apart however it is placed
+    struct partial
+    {
+        int passages = 0;
+        int dead_ends = 0;
+        int junctions = 0;
+        int corridors = 0;
+        int longest_corridor = 0;
+        long long corridor_steps = 0;
+
+        char padding[64];
+    };
+
+    const int *grid_;
+    int width_;
+    int height_;
+
+    bool is_open(int x, int y) const
+    {
+        return x >= 0 && y >= 0 && x < width_ && y < height_ && grid_[y * width_ + x] != maze::BLOCKED;
+    }
+
+    int degree(int x, int y) const
+    {
+        return is_open(x, y - 1) + is_open(x + 1, y) + is_open(x, y + 1) + is_open(x - 1, y);
+    }
+
+    void count_rows(int first_row, int last_row, partial &p) const
+    {
+        static const int dx[4] = { 0, 1, 0, -1 };
+        static const int dy[4] = { -1, 0, 1, 0 };
+
+        for (int y = first_row; y < last_row; y++)
+        {
+            for (int x = 0; x < width_; x++)
+            {
+                if (!is_open(x, y))
+                { continue; }
+
+                int d = degree(x, y);
+                p.passages++;
+
+                if (d == 1)
+                { p.dead_ends++; }
+                else if (d >= 3)
+                { p.junctions++; }
+
+                if (d == 2 || d == 0)
+                { continue; }
+
+                // walk every corridor leaving this dead end / junction, it is
+                // counted by whichever of its two ends comes first in the grid
+                for (int dir = 0; dir < 4; dir++)
+                {
+                    int px = x, py = y;
+                    int cx = x + dx[dir], cy = y + dy[dir];
+                    if (!is_open(cx, cy))
+                    { continue; }
+
+                    int length = 1;
+                    while (degree(cx, cy) == 2)
+                    {
+                        for (int next = 0; next < 4; next++)
+                        {
+                            int nx = cx + dx[next], ny = cy + dy[next];
+                            if (is_open(nx, ny) && !(nx == px && ny == py))
+                            {
+                                px = cx; py = cy;
+                                cx = nx; cy = ny;
+                                break;
+                            }
+                        }
+                        length++;
+                    }
+
+                    if (cy * width_ + cx > y * width_ + x)
+                    {
+                        p.corridors++;
+                        p.corridor_steps += length;
+                        p.longest_corridor = std::max(p.longest_corridor, length);
+                    }
+                }
+            }
+        }
+    }
+
+    // BFS over the whole grid, returns the farthest cell reached and
+    // leaves the distance to every cell in 'dist'
+    int bfs(int source, std::vector<int> &dist, std::vector<int> &queue) const
+    {
+        static const int dx[4] = { 0, 1, 0, -1 };
+        static const int dy[4] = { -1, 0, 1, 0 };
+
+        std::fill(dist.begin(), dist.end(), -1);
+        queue.clear();
+        queue.push_back(source);
+        dist[source] = 0;
+
+        for (size_t head = 0; head < queue.size(); head++)
+        {
+            int cell = queue[head];
+            int x = cell % width_;
+            int y = cell / width_;
+
+            for (int dir = 0; dir < 4; dir++)
+            {
+                int nx = x + dx[dir], ny = y + dy[dir];
+                int next = ny * width_ + nx;
+                if (is_open(nx, ny) && dist[next] < 0)
+                {
+                    dist[next] = dist[cell] + 1;
+                    queue.push_back(next);
+                }
+            }
+        }
+
+        return queue.back();
+    }
+
+    void measure_paths(maze_stats &stats) const
+    {
+        PROFILE_FUNCTION();
+
+        stats.solution_length = -1;
+
+        int start = -1;
+        int exit  = -1;
+        for (int i = 0; i < width_ * height_; i++)
+        {
+            if (start < 0 && grid_[i] != maze::BLOCKED)
+            { start = i; }
+            if (grid_[i] == maze::EXIT)
+            { exit = i; }
+        }
+
+        if (start < 0)
+        { return; }
+
+        std::vector<int> dist(static_cast<size_t>(width_) * height_);
+        std::vector<int> queue;
+        queue.reserve(dist.size());
+
+        // in a perfect maze the cell farthest from any cell is one end of
+        // the longest path, so a second BFS from there gives the diameter
+        int farthest = bfs(start, dist, queue);
+        if (exit >= 0)
+        { stats.solution_length = dist[exit]; }
+
+        farthest = bfs(farthest, dist, queue);
+        stats.diameter = dist[farthest];
+    }
+};
+
+#endif
@@ -1,11 +1,17 @@
 #include <SDL.h>
 #include <SDL_image.h>
 
+#include <chrono>
+#include <cstdlib>
 #include <iostream>
 #include <string>
 
 #include "maze.hpp"
 #include "player.hpp"
+#include "profiler.hpp"
+#include "agents.hpp"
+#include "pathfinding.hpp"
+#include "analytics.hpp"
 
 #define ARRAY_SIZE(a) (sizeof((a)) / sizeof((a)[0]))
 
@@ -38,7 +44,15 @@ static bool load_text(tile_collection *t, const char * const path[], size_t num_
 static void unload_tiles(tile_collection *t);
 static void close(SDL_Window **window);
 static void blit_image(SDL_Surface *dest, SDL_Surface *src, SDL_Rect *coords);
+static bool is_valid_maze_size(int size);
+static int run_agent_benchmark(int argc, char **argv);
+static int run_path_benchmark(int argc, char **argv);
+static int bfs_distance(maze &maze, tile::position from, tile::position to,
+                        std::vector<int> &dist, std::vector<int> &queue);
+static int run_stats_benchmark(int argc, char **argv);
 static void blit_text(SDL_Surface *dest, tile_collection *t, int x, int y);
+static SDL_Surface* create_maze_layer(SDL_Surface *screen, SDL_Surface *path_tile, const int * const generated_maze,
+                                      int maze_width, int maze_height, SDL_Rect *exit_rect);
 
 const char * const g_success_text[] =
 {
@@ -61,7 +75,13 @@ const char * const g_game_tiles[] =
 
 int main(int argc, char **argv)
 {
-    argc = argc; argv = argv;
+    // headless modes, these never touch SDL
+    if (argc > 1 && std::string(argv[1]) == "--agents")
+    { return run_agent_benchmark(argc, argv); }
+    if (argc > 1 && std::string(argv[1]) == "--paths")
+    { return run_path_benchmark(argc, argv); }
+    if (argc > 1 && std::string(argv[1]) == "--stats")
+    { return run_stats_benchmark(argc, argv); }
 
     SDL_Surface *screen = NULL;
     SDL_Surface *images[TOTAL];
@@ -97,42 +117,20 @@ int main(int argc, char **argv)
     maze maze(maze_width, maze_height);
     const int * const generated_maze = maze.generate_maze();
 
-    SDL_Rect offset = {0};
-    offset.w = TILE_WIDTH;
-    offset.h = TILE_HEIGHT;
-    for (int row = 0; row < maze_height; row++)
-    {
-        offset.y = row * TILE_HEIGHT;
-        for (int column = 0; column < maze_width; column++)
-        {
-            const int *tile = &generated_maze[(row * maze_width) + column];
-
-            if (*tile == maze::PASSAGE)
-            {
-                offset.x = column * TILE_WIDTH;
-                blit_image(screen, images[WALKABLE_PATH], &offset);
-            }
-            else if (*tile == maze::EXIT)
-            {
-                offset.x = column * TILE_WIDTH;
-                blit_image(screen, images[WALKABLE_PATH], &offset);
-                blit_image(screen, images[EXIT], &offset);
-            }
-        }
-    }
-
-    SDL_Rect defpos = {0};
-    defpos.x = 0;
-    defpos.y = 0;
-    defpos.w = TILE_WIDTH;
-    defpos.h = TILE_HEIGHT;
-    blit_image(screen, images[PLAYER], &defpos);
+    // walls and passages never change after generation, so they are baked
+    // into their own surface once and composited with a single blit per frame
+    SDL_Rect exit_rect = {0};
+    SDL_Surface *maze_layer = create_maze_layer(screen, images[WALKABLE_PATH], generated_maze,
+                                                maze_width, maze_height, &exit_rect);
+    if (!maze_layer)
+    { return -7; }
 
     // a new player starting at (0, 0) top left corner
     movable_tile player(0, 0, TILE_WIDTH, TILE_HEIGHT);
 
     bool running = true;
     bool game_over = false;
+    bool redraw = true;
     SDL_Event e = {0};
 
     while (running)
@@ -146,6 +144,11 @@ int main(int argc, char **argv)
                 running = false;
                 break;
             }
+            if (e.type == SDL_WINDOWEVENT)
+            {
+                // exposed or resized, the window surface needs the full frame again
+                redraw = true;
+            }
             if (!game_over)
             {
                 if (e.type == SDL_KEYDOWN)
@@ -205,36 +208,42 @@ int main(int argc, char **argv)
                         } break;
                     }
 
-                    SDL_Rect pcurr = {0};
-                    SDL_Rect pprev = {0};
+                    redraw = true;
+                }
+            }
+        }
 
-                    pprev.x = current_logical.x * TILE_WIDTH;
-                    pprev.y = current_logical.y * TILE_HEIGHT;
-                    pprev.w = TILE_WIDTH;
-                    pprev.h = TILE_HEIGHT;
+        if (redraw)
+        {
+            PROFILE_SCOPE("frame");
 
-                    movable_tile::position next_tile = player.get_tile_position();
+            SDL_Rect pcurr = {0};
+            movable_tile::position player_tile = player.get_tile_position();
+            pcurr.x = player_tile.x;
+            pcurr.y = player_tile.y;
+            pcurr.w = TILE_WIDTH;
+            pcurr.h = TILE_HEIGHT;
 
-                    pcurr.x = next_tile.x;
-                    pcurr.y = next_tile.y;
-                    pcurr.w = TILE_WIDTH;
-                    pcurr.h = TILE_HEIGHT;
+            blit_image(screen, maze_layer, NULL);
+            blit_image(screen, images[EXIT], &exit_rect);
+            blit_image(screen, images[PLAYER], &pcurr);
 
-                    blit_image(screen, images[WALKABLE_PATH], &pprev);
-                    blit_image(screen, images[PLAYER], &pcurr);
-                }
-            }
-            else
+            if (game_over)
             {
                 int letter_width  = success_text.tiles[0]->w * static_cast<int>(success_text.num_tiles);
                 int letter_height = success_text.tiles[0]->h;
                 blit_text(screen, &success_text, SCREEN_WIDTH / 2 - letter_width / 2, (SCREEN_HEIGHT / 2) - (letter_height / 2));
             }
 
-            SDL_UpdateWindowSurface(window);
+            {
+                PROFILE_SCOPE("SDL_UpdateWindowSurface");
+                SDL_UpdateWindowSurface(window);
+            }
+            redraw = false;
         }
     }
 
+    SDL_FreeSurface(maze_layer);
     unload_tiles(&success_text);
     delete[] success_text.tiles;
     unload_tiles(&game_tiles);
@@ -245,9 +254,233 @@ int main(int argc, char **argv)
     return 0;
 }
 
+// the generator carves cells two apart starting from (0, 0) and its
+// neighbour checks only stay inside the grid when both sides are odd
+static bool
+is_valid_maze_size(int size)
+{
+    return size >= 3 && size % 2 == 1;
+}
+
+// usage: --agents [count] [steps] [threads] [maze size]
+static int
+run_agent_benchmark(int argc, char **argv)
+{
+    int count     = argc > 2 ? std::atoi(argv[2]) : 10000;
+    int steps     = argc > 3 ? std::atoi(argv[3]) : 1000;
+    int threads   = argc > 4 ? std::atoi(argv[4]) : 0;
+    int maze_size = argc > 5 ? std::atoi(argv[5]) : 201;
+
+    if (count <= 0 || steps <= 0 || threads < 0 || !is_valid_maze_size(maze_size))
+    {
+        std::cout << "usage: --agents [count] [steps] [threads] [maze size]" << std::endl;
+        std::cout << "maze size must be odd and at least 3" << std::endl;
+        return -1;
+    }
+
+    maze maze(maze_size, maze_size);
+    maze.generate_maze();
+
+    agent_swarm swarm(maze);
+    swarm.add_agents(agent_swarm::RANDOM_WALKER,   count - 2 * (count / 3));
+    swarm.add_agents(agent_swarm::WALL_FOLLOWER,   count / 3);
+    swarm.add_agents(agent_swarm::SOLVER_FOLLOWER, count / 3);
+
+    agent_swarm::step_report report = swarm.run(steps, static_cast<unsigned>(threads));
+
+    std::cout << report.agents << " agents x " << report.steps << " steps on "
+              << maze_size << "x" << maze_size << " maze, " << report.threads << " thread(s)" << std::endl;
+    std::cout << report.seconds << " s, " << report.agent_steps_per_second << " agent-steps/s" << std::endl;
+
+    return 0;
+}
+
+// usage: --paths [maze size] [cluster size] [queries]
+static int
+run_path_benchmark(int argc, char **argv)
+{
+    int maze_size    = argc > 2 ? std::atoi(argv[2]) : 401;
+    int cluster_size = argc > 3 ? std::atoi(argv[3]) : 16;
+    int queries      = argc > 4 ? std::atoi(argv[4]) : 10000;
+
+    if (!is_valid_maze_size(maze_size) || cluster_size < 2 || queries <= 0)
+    {
+        std::cout << "usage: --paths [maze size] [cluster size] [queries]" << std::endl;
+        std::cout << "maze size must be odd and at least 3" << std::endl;
+        return -1;
+    }
+
+    maze maze(maze_size, maze_size);
+    maze.generate_maze();
+
+    auto build_start = std::chrono::steady_clock::now();
+    path_index index(maze, cluster_size);
+    std::chrono::duration<double, std::milli> build_time = std::chrono::steady_clock::now() - build_start;
+
+    std::vector<tile::position> passages;
+    for (int y = 0; y < maze_size; y++)
+    {
+        for (int x = 0; x < maze_size; x++)
+        {
+            if (maze.get_tile({ x, y }) != maze::BLOCKED)
+            { passages.push_back({ x, y }); }
+        }
+    }
+
+    std::mt19937 gen(1);
+    std::vector<std::pair<tile::position, tile::position>> pairs;
+    for (int i = 0; i < queries; i++)
+    { pairs.push_back({ passages[gen() % passages.size()], passages[gen() % passages.size()] }); }
+
+    std::vector<size_t> path_sizes;
+    path_sizes.reserve(pairs.size());
+
+    size_t total_length = 0;
+    auto query_start = std::chrono::steady_clock::now();
+    for (const auto &p : pairs)
+    {
+        path_sizes.push_back(index.find_path(p.first, p.second).size());
+        total_length += path_sizes.back();
+    }
+    std::chrono::duration<double, std::micro> query_time = std::chrono::steady_clock::now() - query_start;
+
+    // baseline: an early exit BFS over the full grid for the same pairs
+    std::vector<int> bfs_distances;
+    bfs_distances.reserve(pairs.size());
+    std::vector<int> dist(static_cast<size_t>(maze_size) * maze_size, -1);
+    std::vector<int> queue;
+    queue.reserve(dist.size());
+
+    auto bfs_start = std::chrono::steady_clock::now();
+    for (const auto &p : pairs)
+    { bfs_distances.push_back(bfs_distance(maze, p.first, p.second, dist, queue)); }
+    std::chrono::duration<double, std::micro> bfs_time = std::chrono::steady_clock::now() - bfs_start;
+
+    // a path holds both of its ends, so it is one tile longer than the distance
+    int mismatches = 0;
+    for (size_t i = 0; i < pairs.size(); i++)
+    {
+        if (static_cast<long long>(path_sizes[i]) != bfs_distances[i] + 1)
+        { mismatches++; }
+    }
+
+    std::cout << maze_size << "x" << maze_size << " maze, " << cluster_size << "x" << cluster_size << " clusters" << std::endl;
+    std::cout << "build: " << build_time.count() << " ms, " << index.node_count() << " nodes, "
+              << index.edge_count() << " edges, " << index.memory_bytes() / 1024 << " KiB" << std::endl;
+    std::cout << "query: " << query_time.count() / queries << " us average over " << queries
+              << " queries, " << static_cast<double>(total_length) / queries << " tiles average path" << std::endl;
+    std::cout << "bfs:   " << bfs_time.count() / queries << " us average, speedup over bfs "
+              << bfs_time.count() / query_time.count() << "x" << std::endl;
+
+    if (mismatches)
+    {
+        std::cout << mismatches << " of " << queries << " paths differ in length from BFS" << std::endl;
+        return -2;
+    }
+
+    std::cout << "all " << queries << " path lengths match BFS" << std::endl;
+
+    return 0;
+}
+
+// steps from 'from' to 'to', -1 if unreachable. 'dist' must be all -1 on
+// entry and is left that way, only the cells visited are reset
+static int
+bfs_distance(maze &maze, tile::position from, tile::position to,
+             std::vector<int> &dist, std::vector<int> &queue)
+{
+    int width  = maze.width();
+    int height = maze.height();
+    int source = from.y * width + from.x;
+    int target = to.y * width + to.x;
+
+    queue.clear();
+    queue.push_back(source);
+    dist[source] = 0;
+
+    int result = -1;
+    for (size_t head = 0; head < queue.size(); head++)
+    {
+        int cell = queue[head];
+        if (cell == target)
+        {
+            result = dist[cell];
+            break;
+        }
+
+        tile::position pos = { cell % width, cell / width };
+        const maze::direction dirs[4] = { maze::direction::NORTH, maze::direction::SOUTH,
+                                          maze::direction::EAST, maze::direction::WEST };
+        const bool in_bounds[4] = { pos.y > 0, pos.y < height - 1, pos.x < width - 1, pos.x > 0 };
+        const int offsets[4] = { -width, width, 1, -1 };
+
+        for (int i = 0; i < 4; i++)
+        {
+            int next = cell + offsets[i];
+            if (in_bounds[i] && dist[next] < 0 && maze.get_tile(pos, dirs[i]) != maze::BLOCKED)
+            {
+                dist[next] = dist[cell] + 1;
+                queue.push_back(next);
+            }
+        }
+    }
+
+    for (int cell : queue)
+    { dist[cell] = -1; }
+
+    return result;
+}
+
+// usage: --stats [maze size] [mazes] [threads]
+static int
+run_stats_benchmark(int argc, char **argv)
+{
+    int maze_size = argc > 2 ? std::atoi(argv[2]) : 201;
+    int mazes     = argc > 3 ? std::atoi(argv[3]) : 10;
+    int threads   = argc > 4 ? std::atoi(argv[4]) : 0;
+
+    if (!is_valid_maze_size(maze_size) || mazes <= 0 || threads < 0)
+    {
+        std::cout << "usage: --stats [maze size] [mazes] [threads]" << std::endl;
+        std::cout << "maze size must be odd and at least 3" << std::endl;
+        return -1;
+    }
+
+    std::chrono::duration<double, std::milli> generate_time(0);
+    std::chrono::duration<double, std::milli> analyze_time(0);
+
+    for (int i = 0; i < mazes; i++)
+    {
+        auto generate_start = std::chrono::steady_clock::now();
+        maze maze(maze_size, maze_size);
+        const int * const generated_maze = maze.generate_maze();
+        auto analyze_start = std::chrono::steady_clock::now();
+
+        maze_analytics analytics(generated_maze, maze_size, maze_size);
+        maze_stats stats = analytics.analyze(static_cast<unsigned>(threads));
+        auto analyze_end = std::chrono::steady_clock::now();
+
+        generate_time += analyze_start - generate_start;
+        analyze_time  += analyze_end - analyze_start;
+
+        std::cout << "maze " << i << ": " << stats.passages << " passages, "
+                  << stats.dead_ends << " dead ends, " << stats.junctions << " junctions, "
+                  << stats.corridors << " corridors (longest " << stats.longest_corridor
+                  << ", mean " << stats.mean_corridor << "), solution " << stats.solution_length
+                  << ", diameter " << stats.diameter << std::endl;
+    }
+
+    std::cout << "generate: " << generate_time.count() / mazes << " ms, analyze: "
+              << analyze_time.count() / mazes << " ms average per maze" << std::endl;
+
+    return 0;
+}
+
 static bool
 init(SDL_Window **window, SDL_Surface **window_surface)
 {
+    PROFILE_FUNCTION();
+
     bool success = true;
 
     if (SDL_Init(SDL_INIT_VIDEO) < 0)
@@ -285,6 +518,8 @@ init(SDL_Window **window, SDL_Surface **window_surface)
 static bool
 load_pngs(tile_collection *t, const char * const path[], size_t num_png)
 {
+    PROFILE_FUNCTION();
+
     bool success = true;
 
     for (size_t i = 0; i < num_png; i++)
@@ -305,6 +540,8 @@ load_pngs(tile_collection *t, const char * const path[], size_t num_png)
 static bool
 load_png(SDL_Surface **surface, const char * const path)
 {
+    PROFILE_FUNCTION();
+
     bool success = true;
 
     *surface = IMG_Load(path);
@@ -320,6 +557,8 @@ load_png(SDL_Surface **surface, const char * const path)
 static bool
 load_text(tile_collection *t, const char * const path[], size_t num_files)
 {
+    PROFILE_FUNCTION();
+
     bool success = true;
     for (size_t i = 0; i < num_files && success; i++)
     {
@@ -363,9 +602,51 @@ blit_text(SDL_Surface *dest, tile_collection *t, int x, int y)
     }
 }
 
+static SDL_Surface*
+create_maze_layer(SDL_Surface *screen, SDL_Surface *path_tile, const int * const generated_maze,
+                  int maze_width, int maze_height, SDL_Rect *exit_rect)
+{
+    PROFILE_FUNCTION();
+
+    SDL_Surface *layer = SDL_CreateRGBSurfaceWithFormat(0, screen->w, screen->h,
+                                                        screen->format->BitsPerPixel, screen->format->format);
+    if (!layer)
+    {
+        std::cout << "Could not create maze layer. SDL error: " << SDL_GetError() << std::endl;
+        return nullptr;
+    }
+
+    SDL_FillRect(layer, NULL, SDL_MapRGB(layer->format, 0, 0, 0));
+
+    SDL_Rect offset = {0};
+    offset.w = TILE_WIDTH;
+    offset.h = TILE_HEIGHT;
+    for (int row = 0; row < maze_height; row++)
+    {
+        offset.y = row * TILE_HEIGHT;
+        for (int column = 0; column < maze_width; column++)
+        {
+            const int *tile = &generated_maze[(row * maze_width) + column];
+
+            if (*tile == maze::PASSAGE || *tile == maze::EXIT)
+            {
+                offset.x = column * TILE_WIDTH;
+                blit_image(layer, path_tile, &offset);
+            }
+
+            // the exit marker is a sprite drawn over the layer, only remember where
+            if (*tile == maze::EXIT)
+            { *exit_rect = offset; }
+        }
+    }
+
+    return layer;
+}
+
 static void
 blit_image(SDL_Surface *dest, SDL_Surface *src, SDL_Rect *coords)
 {
+    PROFILE_FUNCTION();
     SDL_BlitSurface(src, NULL, dest, coords);
 }
 
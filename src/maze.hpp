@@ -7,6 +7,7 @@
 #include <algorithm>
 #include <vector>
 
+#include "profiler.hpp"
 #include "tile.hpp"
 
 class maze
@@ -27,6 +28,14 @@ public:
     {
     }
 
+    int width() const { return width_; }
+    int height() const { return height_; }
+
+    enum tile_state get_tile(tile::position pos)
+    {
+        return static_cast<enum tile_state>(maze_.get()[pos.y * width_ + pos.x]);
+    }
+
     enum tile_state get_tile(tile::position pos, enum class direction dir)
     {
         if (dir == direction::NORTH)
@@ -49,6 +58,7 @@ public:
 
     const int * const generate_maze()
     {
+        PROFILE_FUNCTION();
         seed_maze();
         create_maze();
         return maze_.get();
@@ -256,14 +266,23 @@ private:
         if (east_neighbour  && is_blocked(east_neighbour))  { frontier.insert(east_neighbour); }
         if (west_neighbour  && is_blocked(west_neighbour))  { frontier.insert(west_neighbour); }
 
+        int cells_carved = 1;
+
         while (frontier.size())
         {
+            // sampled, one event per carve would swamp the trace
+            if (cells_carved % 64 == 1)
+            {
+                PROFILE_COUNTER("frontier size", frontier.size());
+                PROFILE_COUNTER("cells carved", cells_carved);
+            }
 
             frontier_cell = pick_random_frontier_cell(frontier);
             *frontier_cell = PASSAGE;
             std::vector<cell_mark> neighbours = get_neighbour_passages(frontier_cell);
             cell_mark random_neighbour = get_random_neighbour_passage(neighbours);
             mark_passage(random_neighbour);
+            cells_carved += 2;
 
             // add new passage's neighbours as new frontier cells
             north_neighbour = NORTH(NORTH(frontier_cell));
@@ -279,6 +298,9 @@ private:
             frontier.erase(frontier_cell);
         }
 
+        PROFILE_COUNTER("frontier size", 0);
+        PROFILE_COUNTER("cells carved", cells_carved);
+
         *frontier_cell = EXIT;
     }
 
@@ -0,0 +1,528 @@
+#ifndef PATHFINDING_HPP
+#define PATHFINDING_HPP
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "maze.hpp"
+#include "profiler.hpp"
+#include "tile.hpp"
+
+// HPA*-style index for answering many path queries on the same maze.
+// The grid is cut into square clusters, entrances are placed where a
+// passage crosses a cluster border and the distances between entrances of
+// the same cluster are precomputed. Every entrance also keeps a table of
+// which way to step from each cell of its cluster to get closer to it, so
+// a query only searches the small abstract graph of entrances and refining
+// a hop into tiles is a walk through that table.
+class path_index
+{
+public:
+    path_index(maze &m, int cluster_size = 16)
+        : width_(m.width()), height_(m.height()),
+          cluster_size_(std::max(2, cluster_size)),
+          clusters_x_((m.width() + std::max(2, cluster_size) - 1) / std::max(2, cluster_size)),
+          clusters_y_((m.height() + std::max(2, cluster_size) - 1) / std::max(2, cluster_size))
+    {
+        PROFILE_SCOPE("path_index build");
+
+        open_.assign(static_cast<size_t>(width_) * height_, 0);
+        for (int y = 0; y < height_; y++)
+        {
+            for (int x = 0; x < width_; x++)
+            {
+                open_[y * width_ + x] = m.get_tile({ x, y }) != maze::BLOCKED;
+            }
+        }
+
+        cluster_nodes_.resize(static_cast<size_t>(clusters_x_) * clusters_y_);
+
+        find_entrances();
+        connect_entrances();
+    }
+
+    ~path_index()
+    {
+    }
+
+    size_t node_count() const { return nodes_.size(); }
+    size_t edge_count() const { return edge_list_.size(); }
+
+    // approximate heap footprint of the index, hash map nodes included
+    size_t memory_bytes() const
+    {
+        size_t bytes = open_.capacity() * sizeof(uint8_t);
+        bytes += nodes_.capacity() * sizeof(node);
+        bytes += edge_begin_.capacity() * sizeof(int);
+        bytes += edge_list_.capacity() * sizeof(edge);
+        bytes += toward_.capacity() * sizeof(uint8_t);
+        bytes += cluster_nodes_.capacity() * sizeof(std::vector<int>);
+        for (const auto &c : cluster_nodes_)
+        { bytes += c.capacity() * sizeof(int); }
+        bytes += node_at_.bucket_count() * sizeof(void*);
+        bytes += node_at_.size() * (sizeof(std::pair<const int, int>) + 2 * sizeof(void*));
+        return bytes;
+    }
+
+    // path from 'from' to 'to', both ends included,
+    // empty if either end is blocked or the two are not connected
+    std::vector<tile::position> find_path(tile::position from, tile::position to) const
+    {
+        PROFILE_FUNCTION();
+
+        // reused between queries on this thread, so a query allocates
+        // nothing but its result once the buffers have grown
+        static thread_local search_scratch scratch;
+
+        std::vector<tile::position> path;
+
+        if (!is_open(from) || !is_open(to))
+        { return path; }
+
+        int from_cell = cell_of(from);
+        int to_cell   = cell_of(to);
+        int from_cluster = cluster_of(from_cell);
+        int to_cluster   = cluster_of(to_cell);
+
+        // parents of a BFS from the goal lead towards it, which covers both
+        // queries that stay in one cluster and the final hop of the others
+        bfs_scratch &to_bfs = scratch.to_bfs;
+        cluster_bfs(to_cluster, to_cell, to_bfs);
+
+        if (from_cluster == to_cluster && to_bfs.dist[local_of(to_cluster, from_cell)] >= 0)
+        {
+            path.push_back(from);
+            walk_to_goal(path, to_cluster, from_cell, to_cell, to_bfs);
+            return path;
+        }
+
+        bfs_scratch &from_bfs = scratch.from_bfs;
+        cluster_bfs(from_cluster, from_cell, from_bfs);
+
+        const int START = static_cast<int>(nodes_.size());
+        const int GOAL  = START + 1;
+        const int to_x = to.x;
+        const int to_y = to.y;
+
+        scratch.begin(nodes_.size() + 2);
+
+        auto heuristic = [&](int id)
+        {
+            int x = id == START ? from.x : (id == GOAL ? to_x : nodes_[id].x);
+            int y = id == START ? from.y : (id == GOAL ? to_y : nodes_[id].y);
+            return std::abs(x - to_x) + std::abs(y - to_y);
+        };
+
+        std::vector<entry> &heap = scratch.heap;
+        auto push = [&](int id, int cost, int parent)
+        {
+            scratch.set(id, cost, parent);
+            heap.push_back({ cost + heuristic(id), id });
+            std::push_heap(heap.begin(), heap.end(), std::greater<entry>());
+        };
+
+        push(START, 0, -1);
+
+        bool found = false;
+        while (!heap.empty())
+        {
+            std::pop_heap(heap.begin(), heap.end(), std::greater<entry>());
+            entry top = heap.back();
+            heap.pop_back();
+
+            int id = top.second;
+            int cost = scratch.cost(id);
+            if (top.first != cost + heuristic(id))
+            { continue; } // stale entry
+
+            if (id == GOAL)
+            {
+                found = true;
+                break;
+            }
+
+            auto relax = [&](int next, int step)
+            {
+                if (cost + step < scratch.cost(next))
+                { push(next, cost + step, id); }
+            };
+
+            if (id == START)
+            {
+                for (int n : cluster_nodes_[from_cluster])
+                {
+                    int d = from_bfs.dist[local_of(from_cluster, nodes_[n].cell)];
+                    if (d >= 0)
+                    { relax(n, d); }
+                }
+            }
+            else
+            {
+                for (int e = edge_begin_[id]; e < edge_begin_[id + 1]; e++)
+                { relax(edge_list_[e].to, edge_list_[e].cost); }
+
+                if (nodes_[id].cluster == to_cluster)
+                {
+                    int d = to_bfs.dist[local_of(to_cluster, nodes_[id].cell)];
+                    if (d >= 0)
+                    { relax(GOAL, d); }
+                }
+            }
+        }
+
+        if (!found)
+        { return path; }
+
+        std::vector<int> &hops = scratch.hops;
+        hops.clear();
+        for (int id = GOAL; id != START; id = scratch.parent[id])
+        { hops.push_back(id); }
+
+        path.push_back(from);
+        int cell = from_cell;
+        for (auto it = hops.rbegin(); it != hops.rend(); ++it)
+        {
+            if (*it == GOAL)
+            {
+                walk_to_goal(path, to_cluster, cell, to_cell, to_bfs);
+                break;
+            }
+
+            const node &n = nodes_[*it];
+            if (cluster_of(cell) == n.cluster)
+            { walk_to_node(path, *it, cell); }
+            else
+            { path.push_back({ n.x, n.y }); } // entrance pair, always adjacent
+            cell = n.cell;
+        }
+
+        return path;
+    }
+
+private:
+    // entrance runs at least this long get a node at each end
+    // instead of a single one in the middle
+    static constexpr int LONG_ENTRANCE = 6;
+
+    // directions in the toward_ tables, HERE marks the entrance itself
+    // and cells it can't be reached from inside the cluster
+    enum step { NORTH = 0, EAST = 1, SOUTH = 2, WEST = 3, HERE = 4 };
+
+    struct edge
+    {
+        int to;
+        int cost;
+    };
+
+    struct node
+    {
+        int cell;
+        int cluster;
+        int x;
+        int y;
+    };
+
+    typedef std::pair<int, int> entry; // f, id
+
+    struct bfs_scratch
+    {
+        std::vector<int> dist;   // indexed by local_of
+        std::vector<int> parent; // cell one step closer to the source
+        std::vector<int> queue;
+    };
+
+    // per-thread query state. Entries of g/parent only count when their
+    // stamp matches the current query, so nothing is cleared in between
+    struct search_scratch
+    {
+        bfs_scratch from_bfs;
+        bfs_scratch to_bfs;
+
+        std::vector<int> g;
+        std::vector<int> parent;
+        std::vector<uint32_t> stamp;
+        uint32_t generation = 0;
+
+        std::vector<entry> heap;
+        std::vector<int> hops;
+
+        void begin(size_t size)
+        {
+            if (stamp.size() < size)
+            {
+                g.resize(size);
+                parent.resize(size);
+                stamp.resize(size, 0);
+            }
+
+            if (++generation == 0)
+            {
+                std::fill(stamp.begin(), stamp.end(), 0);
+                generation = 1;
+            }
+
+            heap.clear();
+        }
+
+        int cost(int id) const { return stamp[id] == generation ? g[id] : INT_MAX; }
+
+        void set(int id, int cost, int from)
+        {
+            stamp[id] = generation;
+            g[id] = cost;
+            parent[id] = from;
+        }
+    };
+
+    int width_;
+    int height_;
+    int cluster_size_;
+    int clusters_x_;
+    int clusters_y_;
+
+    std::vector<uint8_t> open_;
+
+    std::vector<node> nodes_;
+    std::vector<int> edge_begin_; // node i's edges are edge_list_[edge_begin_[i], edge_begin_[i + 1])
+    std::vector<edge> edge_list_;
+    std::vector<std::vector<int>> cluster_nodes_;
+    std::unordered_map<int, int> node_at_; // cell -> node
+
+    // cluster_size^2 steps per node, indexed by local_of
+    std::vector<uint8_t> toward_;
+
+    // only used while building, flattened into edge_begin_ / edge_list_
+    std::vector<std::vector<edge>> edges_;
+
+    bool is_open(tile::position pos) const
+    {
+        return pos.x >= 0 && pos.y >= 0 && pos.x < width_ && pos.y < height_ && open_[cell_of(pos)];
+    }
+
+    int cell_of(tile::position pos) const { return pos.y * width_ + pos.x; }
+    tile::position position_of(int cell) const { return { cell % width_, cell / width_ }; }
+
+    int cluster_of(int cell) const
+    {
+        return (cell / width_ / cluster_size_) * clusters_x_ + (cell % width_) / cluster_size_;
+    }
+
+    // index of 'cell' inside its cluster, rows are cluster_size_ wide even
+    // for the clipped clusters on the right and bottom edges
+    int local_of(int cluster, int cell) const
+    {
+        int x0 = (cluster % clusters_x_) * cluster_size_;
+        int y0 = (cluster / clusters_x_) * cluster_size_;
+        return (cell / width_ - y0) * cluster_size_ + (cell % width_ - x0);
+    }
+
+    int get_or_add_node(int cell)
+    {
+        auto it = node_at_.find(cell);
+        if (it != node_at_.end())
+        { return it->second; }
+
+        int id = static_cast<int>(nodes_.size());
+        nodes_.push_back({ cell, cluster_of(cell), cell % width_, cell / width_ });
+        edges_.emplace_back();
+        cluster_nodes_[cluster_of(cell)].push_back(id);
+        node_at_[cell] = id;
+        return id;
+    }
+
+    void add_entrance(int a, int b)
+    {
+        int na = get_or_add_node(a);
+        int nb = get_or_add_node(b);
+        edges_[na].push_back({ nb, 1 });
+        edges_[nb].push_back({ na, 1 });
+    }
+
+    // walks one cluster border, 'step' moves along the border and 'across'
+    // is the offset to the cell on the other side
+    void scan_border(int first, int length, int step, int across)
+    {
+        int run_start = -1;
+        for (int i = 0; i <= length; i++)
+        {
+            int cell = first + i * step;
+            bool crossing = i < length && open_[cell] && open_[cell + across];
+
+            if (crossing && run_start < 0)
+            {
+                run_start = i;
+            }
+            else if (!crossing && run_start >= 0)
+            {
+                int run = i - run_start;
+                if (run >= LONG_ENTRANCE)
+                {
+                    add_entrance(first + run_start * step, first + run_start * step + across);
+                    add_entrance(first + (i - 1) * step, first + (i - 1) * step + across);
+                }
+                else
+                {
+                    int mid = first + (run_start + run / 2) * step;
+                    add_entrance(mid, mid + across);
+                }
+                run_start = -1;
+            }
+        }
+    }
+
+    void find_entrances()
+    {
+        for (int cy = 0; cy < clusters_y_; cy++)
+        {
+            for (int cx = 0; cx < clusters_x_; cx++)
+            {
+                int x0 = cx * cluster_size_;
+                int y0 = cy * cluster_size_;
+                int w  = std::min(cluster_size_, width_ - x0);
+                int h  = std::min(cluster_size_, height_ - y0);
+
+                if (cx + 1 < clusters_x_) // east border
+                { scan_border(y0 * width_ + x0 + w - 1, h, width_, 1); }
+
+                if (cy + 1 < clusters_y_) // south border
+                { scan_border((y0 + h - 1) * width_ + x0, w, 1, width_); }
+            }
+        }
+    }
+
+    // BFS from 'source' that never leaves 'cluster'
+    void cluster_bfs(int cluster, int source, bfs_scratch &bfs) const
+    {
+        int x0 = (cluster % clusters_x_) * cluster_size_;
+        int y0 = (cluster / clusters_x_) * cluster_size_;
+        int w  = std::min(cluster_size_, width_ - x0);
+        int h  = std::min(cluster_size_, height_ - y0);
+
+        size_t area = static_cast<size_t>(cluster_size_) * cluster_size_;
+        bfs.dist.assign(area, -1);
+        bfs.parent.assign(area, -1);
+
+        // every cell is queued at most once, so a flat vector is enough
+        std::vector<int> &queue = bfs.queue;
+        queue.clear();
+        queue.push_back(source);
+        bfs.dist[local_of(cluster, source)] = 0;
+
+        for (size_t head = 0; head < queue.size(); head++)
+        {
+            int cell = queue[head];
+
+            int x = cell % width_;
+            int y = cell / width_;
+            int d = bfs.dist[local_of(cluster, cell)];
+
+            const int nx[4] = { x, x + 1, x, x - 1 };
+            const int ny[4] = { y - 1, y, y + 1, y };
+            for (int i = 0; i < 4; i++)
+            {
+                if (nx[i] < x0 || ny[i] < y0 || nx[i] >= x0 + w || ny[i] >= y0 + h)
+                { continue; }
+
+                int next = ny[i] * width_ + nx[i];
+                int l = (ny[i] - y0) * cluster_size_ + (nx[i] - x0);
+                if (!open_[next] || bfs.dist[l] >= 0)
+                { continue; }
+
+                bfs.dist[l] = d + 1;
+                bfs.parent[l] = cell;
+                queue.push_back(next);
+            }
+        }
+    }
+
+    // one BFS per entrance gives both its in-cluster edges and its toward_ table
+    void connect_entrances()
+    {
+        size_t area = static_cast<size_t>(cluster_size_) * cluster_size_;
+        toward_.assign(nodes_.size() * area, HERE);
+
+        bfs_scratch bfs;
+        for (size_t cluster = 0; cluster < cluster_nodes_.size(); cluster++)
+        {
+            int c = static_cast<int>(cluster);
+            for (int id : cluster_nodes_[cluster])
+            {
+                cluster_bfs(c, nodes_[id].cell, bfs);
+
+                for (int other : cluster_nodes_[cluster])
+                {
+                    int d = bfs.dist[local_of(c, nodes_[other].cell)];
+                    if (other != id && d >= 0)
+                    { edges_[id].push_back({ other, d }); }
+                }
+
+                uint8_t *table = &toward_[id * area];
+                for (int cell : bfs.queue)
+                {
+                    int l = local_of(c, cell);
+                    int parent = bfs.parent[l];
+                    if (parent >= 0)
+                    { table[l] = static_cast<uint8_t>(step_between(cell, parent)); }
+                }
+            }
+        }
+
+        edge_begin_.assign(nodes_.size() + 1, 0);
+        for (size_t i = 0; i < edges_.size(); i++)
+        { edge_begin_[i + 1] = edge_begin_[i] + static_cast<int>(edges_[i].size()); }
+
+        edge_list_.reserve(edge_begin_.back());
+        for (const auto &e : edges_)
+        { edge_list_.insert(edge_list_.end(), e.begin(), e.end()); }
+
+        std::vector<std::vector<edge>>().swap(edges_);
+    }
+
+    int step_between(int cell, int neighbour) const
+    {
+        if (neighbour == cell - width_) { return NORTH; }
+        if (neighbour == cell + 1)      { return EAST; }
+        if (neighbour == cell + width_) { return SOUTH; }
+        return WEST;
+    }
+
+    int step_offset(int dir) const
+    {
+        const int offsets[4] = { -width_, 1, width_, -1 };
+        return offsets[dir];
+    }
+
+    // appends the tiles after 'cell' up to and including entrance 'id',
+    // 'cell' must be in the same cluster and able to reach it
+    void walk_to_node(std::vector<tile::position> &path, int id, int cell) const
+    {
+        size_t area = static_cast<size_t>(cluster_size_) * cluster_size_;
+        const uint8_t *table = &toward_[id * area];
+        const node &target = nodes_[id];
+
+        while (cell != target.cell)
+        {
+            cell += step_offset(table[local_of(target.cluster, cell)]);
+            path.push_back(position_of(cell));
+        }
+    }
+
+    // same as walk_to_node, for the goal, using the BFS run from it
+    void walk_to_goal(std::vector<tile::position> &path, int cluster, int cell, int goal,
+                      const bfs_scratch &to_bfs) const
+    {
+        while (cell != goal)
+        {
+            cell = to_bfs.parent[local_of(cluster, cell)];
+            path.push_back(position_of(cell));
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,234 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+// Scoped timers and counters that are written out as a Chrome trace
+// (chrome://tracing, ui.perfetto.dev) when the program exits.
+// Everything compiles away unless MAZE_PROFILE is defined, see vprofile.ps1.
+//
+//   PROFILE_FUNCTION();               times the enclosing function
+//   PROFILE_SCOPE("name");            times the enclosing scope
+//   PROFILE_COUNTER("name", value);   samples a value over time
+//
+// Names must outlive the program (string literals or __FUNCTION__).
+
+#ifdef MAZE_PROFILE
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#ifndef MAZE_PROFILE_OUTPUT
+#define MAZE_PROFILE_OUTPUT "maze_trace.json"
+#endif
+
+class profiler
+{
+public:
+    class scoped_timer
+    {
+    public:
+        scoped_timer(const char *name)
+            : name_(name), start_(profiler::now_ns())
+        {}
+
+        ~scoped_timer()
+        {
+            profiler::record(name_, 'X', start_, profiler::now_ns() - start_, 0.0);
+        }
+
+        scoped_timer(const scoped_timer &) = delete;
+        scoped_timer &operator=(const scoped_timer &) = delete;
+
+    private:
+        const char *name_;
+        uint64_t start_;
+    };
+
+    static void counter(const char *name, double value)
+    {
+        record(name, 'C', now_ns(), 0, value);
+    }
+
+    // nanoseconds since the profiler was first used
+    static uint64_t now_ns()
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - get_registry().epoch).count());
+    }
+
+    static bool dump(const char *path)
+    {
+        registry &r = get_registry();
+        std::lock_guard<std::mutex> guard(r.lock);
+
+        std::ofstream out(path);
+        if (!out)
+        {
+            std::cout << "Could not write profile to " << path << std::endl;
+            return false;
+        }
+
+        out << std::fixed << std::setprecision(3);
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+        bool first = true;
+        uint64_t dropped = 0;
+        for (const auto &buffer : r.buffers)
+        {
+            size_t count = buffer->count.load(std::memory_order_acquire);
+            dropped += buffer->dropped.load(std::memory_order_relaxed);
+
+            for (size_t i = 0; i < count; i++)
+            {
+                const event &e = buffer->events[i];
+
+                out << (first ? "\n" : ",\n");
+                first = false;
+
+                out << "{\"name\":\"";
+                write_escaped(out, e.name);
+                out << "\",\"ph\":\"" << e.phase << "\",\"pid\":1,\"tid\":" << buffer->tid
+                    << ",\"ts\":" << e.start_ns / 1000.0;
+
+                if (e.phase == 'X')
+                { out << ",\"dur\":" << e.duration_ns / 1000.0; }
+                else
+                { out << ",\"args\":{\"value\":" << e.value << "}"; }
+
+                out << "}";
+            }
+        }
+
+        out << "\n],\"otherData\":{\"dropped_events\":" << dropped << "}}\n";
+
+        return static_cast<bool>(out);
+    }
+
+private:
+    // events past this many on one thread are dropped (and counted)
+    static constexpr size_t EVENTS_PER_THREAD = 1 << 16;
+
+    struct event
+    {
+        const char *name;
+        uint64_t start_ns;
+        uint64_t duration_ns;
+        double value;
+        char phase; // 'X' complete, 'C' counter
+    };
+
+    // only the owning thread appends, so publishing 'count' with release
+    // is all the synchronisation a concurrent dump needs
+    struct thread_buffer
+    {
+        std::unique_ptr<event[]> events;
+        std::atomic<size_t> count;
+        std::atomic<uint64_t> dropped;
+        int tid;
+    };
+
+    struct registry
+    {
+        std::mutex lock;
+        std::vector<std::unique_ptr<thread_buffer>> buffers;
+        std::chrono::steady_clock::time_point epoch;
+    };
+
+    // deliberately never destroyed so buffers are still alive when the
+    // exit handler runs, whatever order other statics are torn down in
+    static registry &get_registry()
+    {
+        static registry *r = create_registry();
+        return *r;
+    }
+
+    static registry *create_registry()
+    {
+        registry *r = new registry();
+        r->epoch = std::chrono::steady_clock::now();
+        std::atexit(dump_at_exit);
+        return r;
+    }
+
+    static void dump_at_exit()
+    {
+        dump(MAZE_PROFILE_OUTPUT);
+    }
+
+    // the mutex is only taken the first time a thread records something
+    static thread_buffer &local_buffer()
+    {
+        static thread_local thread_buffer *buffer = nullptr;
+        if (!buffer)
+        {
+            registry &r = get_registry();
+            std::lock_guard<std::mutex> guard(r.lock);
+
+            std::unique_ptr<thread_buffer> b(new thread_buffer());
+            b->events.reset(new event[EVENTS_PER_THREAD]);
+            b->count.store(0, std::memory_order_relaxed);
+            b->dropped.store(0, std::memory_order_relaxed);
+            b->tid = static_cast<int>(r.buffers.size());
+
+            buffer = b.get();
+            r.buffers.push_back(std::move(b));
+        }
+
+        return *buffer;
+    }
+
+    static void record(const char *name, char phase, uint64_t start_ns, uint64_t duration_ns, double value)
+    {
+        thread_buffer &b = local_buffer();
+
+        size_t index = b.count.load(std::memory_order_relaxed);
+        if (index >= EVENTS_PER_THREAD)
+        {
+            b.dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        event &e = b.events[index];
+        e.name = name;
+        e.start_ns = start_ns;
+        e.duration_ns = duration_ns;
+        e.value = value;
+        e.phase = phase;
+
+        b.count.store(index + 1, std::memory_order_release);
+    }
+
+    static void write_escaped(std::ofstream &out, const char *s)
+    {
+        for (; *s; s++)
+        {
+            if (*s == '"' || *s == '\\')
+            { out << '\\'; }
+            out << *s;
+        }
+    }
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+#define PROFILE_SCOPE(name) profiler::scoped_timer PROFILE_CONCAT(profile_scope_, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__FUNCTION__)
+#define PROFILE_COUNTER(name, value) profiler::counter((name), static_cast<double>(value))
+
+#else
+
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_FUNCTION() ((void)0)
+#define PROFILE_COUNTER(name, value) ((void)sizeof(value))
+
+#endif
+
+#endif
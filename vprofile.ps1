@@ -0,0 +1,3 @@
+pushd .\build
+cl ..\src\main.cpp /O2 /W4 /EHsc /DMAZE_PROFILE SDL2.lib SDL2main.lib SDL2_image.lib -link /subsystem:console /MACHINE:X64
+popd